@@ -0,0 +1,210 @@
+/*
+ * Compile-time struct to DTLV binding for C++ callers.
+ *
+ * A structure is described once as a list of field descriptors:
+ *
+ *	typedef dtlv_bind::object<
+ *		DTLV_BIND_FIELD(point_t, x, 1),
+ *		DTLV_BIND_FIELD(point_t, name, 2)
+ *	> point_bind_t;
+ *
+ *	point_bind_t::encode(&dtlv_ctx, point);
+ *	point_bind_t::decode(&dtlv_ctx, point);
+ *
+ * Field types are checked when the descriptor is instantiated: only
+ * uint8, uint16, uint32, char[N] (DTLV_TYPE_CHAR), uint8[N]
+ * (DTLV_TYPE_OCTETS) and structures declared with DTLV_BIND_GROUPING
+ * (DTLV_TYPE_OBJECT) are accepted, and AVP codes must be unique within
+ * an object. The encoder and the decoder dispatch are expanded per
+ * field, so no runtime type table is involved.
+ */
+#ifndef _DTLV_BIND_HPP_
+#define _DTLV_BIND_HPP_
+
+extern "C" {
+	#include "proto/dtlv.h"
+}
+
+#define DTLV_BIND_CODE_MAX	1023
+
+namespace dtlv_bind {
+
+/* Per type encode/decode; left undefined for unsupported field types */
+template <typename T>
+struct avp_traits;
+
+template <>
+struct avp_traits<uint8> {
+	static const dtlv_datatype_t datatype = DTLV_TYPE_INTEGER;
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, avp_code_t code, const uint8& value) { return dtlv_avp_encode_uint8(ctx, code, value); }
+	static dtlv_errcode_t decode(dtlv_davp_t* avp, uint8& value) { return dtlv_avp_get_uint8(avp, &value); }
+};
+
+template <>
+struct avp_traits<uint16> {
+	static const dtlv_datatype_t datatype = DTLV_TYPE_INTEGER;
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, avp_code_t code, const uint16& value) { return dtlv_avp_encode_uint16(ctx, code, value); }
+	static dtlv_errcode_t decode(dtlv_davp_t* avp, uint16& value) { return dtlv_avp_get_uint16(avp, &value); }
+};
+
+template <>
+struct avp_traits<uint32> {
+	static const dtlv_datatype_t datatype = DTLV_TYPE_INTEGER;
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, avp_code_t code, const uint32& value) { return dtlv_avp_encode_uint32(ctx, code, value); }
+	static dtlv_errcode_t decode(dtlv_davp_t* avp, uint32& value) { return dtlv_avp_get_uint32(avp, &value); }
+};
+
+template <size_t N>
+struct avp_traits<char[N]> {
+	static const dtlv_datatype_t datatype = DTLV_TYPE_CHAR;
+	/* unterminated arrays are rejected, same as on decode */
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, avp_code_t code, const char (&value)[N])
+	{
+		if (strnlen(value, N) == N)
+			return DTLV_AVP_INVALID_LEN;
+		return dtlv_avp_encode_nchar(ctx, code, N, value);
+	}
+	static dtlv_errcode_t decode(dtlv_davp_t* avp, char (&value)[N])
+	{
+		dtlv_size_t length = d_avp_data_length(avp->havpd.length);
+		size_t slen = strnlen(avp->avp->data, length);
+		if (slen >= N)
+			return DTLV_AVP_INVALID_LEN;
+		os_memcpy(value, avp->avp->data, slen);
+		value[slen] = '\0';
+		return DTLV_ERR_SUCCESS;
+	}
+};
+
+template <size_t N>
+struct avp_traits<uint8[N]> {
+	static const dtlv_datatype_t datatype = DTLV_TYPE_OCTETS;
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, avp_code_t code, const uint8 (&value)[N]) { return dtlv_avp_encode_octets(ctx, code, N, (const char *) value); }
+	static dtlv_errcode_t decode(dtlv_davp_t* avp, uint8 (&value)[N])
+	{
+		if (d_avp_data_length(avp->havpd.length) != N)
+			return DTLV_AVP_INVALID_LEN;
+		os_memcpy(value, avp->avp->data, N);
+		return DTLV_ERR_SUCCESS;
+	}
+};
+
+/* Nested structure encoded as a grouping AVP */
+template <typename B>
+struct grouping {
+	static const dtlv_datatype_t datatype = DTLV_TYPE_OBJECT;
+
+	template <typename S>
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, avp_code_t code, const S& value)
+	{
+		dtlv_avp_t* gavp;
+		dtlv_errcode_t res = dtlv_avp_encode_grouping(ctx, 0, code, &gavp);
+		if (res != DTLV_ERR_SUCCESS)
+			return res;
+		res = B::encode(ctx, value);
+		if (res != DTLV_ERR_SUCCESS)
+			return res;
+		return dtlv_avp_encode_group_done(ctx, gavp);
+	}
+
+	template <typename S>
+	static dtlv_errcode_t decode(dtlv_davp_t* avp, S& value)
+	{
+		dtlv_ctx_t dtlv_ctx;
+		dtlv_errcode_t res = dtlv_ctx_init_decode(&dtlv_ctx, avp->avp->data, d_avp_data_length(avp->havpd.length));
+		if (res != DTLV_ERR_SUCCESS)
+			return res;
+		return B::decode(&dtlv_ctx, value);
+	}
+};
+
+template <typename S, typename T, T S::*Member, avp_code_t Code>
+struct field {
+	static_assert(Code <= DTLV_BIND_CODE_MAX, "AVP code out of range");
+
+	typedef avp_traits<T> traits;
+	static const avp_code_t code = Code;
+
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, const S& value)
+	{
+		return traits::encode(ctx, Code, value.*Member);
+	}
+
+	static dtlv_errcode_t decode(dtlv_davp_t* avp, S& value)
+	{
+		if (avp->havpd.datatype != traits::datatype)
+			return DTLV_AVP_INV_TYPE;
+		return traits::decode(avp, value.*Member);
+	}
+};
+
+template <avp_code_t Code, typename... Fields>
+struct has_code;
+
+template <avp_code_t Code>
+struct has_code<Code> {
+	static const bool value = false;
+};
+
+template <avp_code_t Code, typename F, typename... Rest>
+struct has_code<Code, F, Rest...> {
+	static const bool value = (F::code == Code) || has_code<Code, Rest...>::value;
+};
+
+template <typename... Fields>
+struct object;
+
+template <>
+struct object<> {
+	template <typename S>
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, const S& value) { return DTLV_ERR_SUCCESS; }
+
+	/* AVPs that are not bound are skipped */
+	template <typename S>
+	static dtlv_errcode_t decode_avp(dtlv_davp_t* avp, S& value) { return DTLV_ERR_SUCCESS; }
+};
+
+template <typename F, typename... Rest>
+struct object<F, Rest...> {
+	static_assert(!has_code<F::code, Rest...>::value, "duplicate AVP code");
+
+	template <typename S>
+	static dtlv_errcode_t encode(dtlv_ctx_t* ctx, const S& value)
+	{
+		dtlv_errcode_t res = F::encode(ctx, value);
+		if (res != DTLV_ERR_SUCCESS)
+			return res;
+		return object<Rest...>::encode(ctx, value);
+	}
+
+	template <typename S>
+	static dtlv_errcode_t decode_avp(dtlv_davp_t* avp, S& value)
+	{
+		if ((avp->havpd.nscode.comp.namespace_id == 0) && (avp->havpd.nscode.comp.code == F::code))
+			return F::decode(avp, value);
+		return object<Rest...>::decode_avp(avp, value);
+	}
+
+	template <typename S>
+	static dtlv_errcode_t decode(dtlv_ctx_t* ctx, S& value)
+	{
+		dtlv_davp_t avp;
+		dtlv_errcode_t res;
+		while ((res = dtlv_avp_decode(ctx, &avp)) == DTLV_ERR_SUCCESS) {
+			res = decode_avp(&avp, value);
+			if (res != DTLV_ERR_SUCCESS)
+				return res;
+		}
+		return (res == DTLV_END_OF_DATA) ? DTLV_ERR_SUCCESS : res;
+	}
+};
+
+} // namespace dtlv_bind
+
+#define DTLV_BIND_FIELD(S, member, code) \
+	dtlv_bind::field<S, decltype(S::member), &S::member, code>
+
+#define DTLV_BIND_GROUPING(S, binding) \
+	namespace dtlv_bind { template <> struct avp_traits<S> : grouping<binding> {}; }
+
+#endif /* _DTLV_BIND_HPP_ */
@@ -1,4 +1,8 @@
 #include "gtest/gtest.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
 
 extern "C" {
 	#include "misc/idxhash.h"
@@ -177,3 +181,268 @@ TEST_F(IdxHashFixedKey, TestFullFillAndCompact)
 	}
 
 }
+
+#ifdef PERF_TEST
+#define PERF_BUFFER_SIZE	16384
+#define PERF_READERS_MAX	16
+#define PERF_SEARCH_COUNT	1000000
+
+class IdxHashPerfClass : public ::testing::Test {
+protected:
+	void SetUp()
+	{
+		ASSERT_EQ(ih_init8(buf, sizeof(buf), 255, sizeof(void*), 2, &hndlr), IH_ERR_SUCCESS);
+
+		uint16* value = 0;
+		void* key = (void*) 0xFFFF;
+		entry_count = 0;
+		while (ih_hash8_add(hndlr, (const char *) &key, 0, (char**)&value, 0) == IH_ERR_SUCCESS) {
+			*value = entry_count + 1;
+			key = (void*) ((char *) key + 1);
+			entry_count++;
+		}
+		// leave a free slot for the writer
+		key = (void*) ((char *) 0xFFFF + entry_count - 1);
+		ASSERT_EQ(ih_hash8_remove(hndlr, (const char *) &key, 0), IH_ERR_SUCCESS);
+		entry_count--;
+
+		pthread_rwlock_init(&lock, NULL);
+	}
+	void TearDown()
+	{
+		pthread_rwlock_destroy(&lock);
+	}
+
+	ih_hndlr_t		hndlr;
+	char			buf[PERF_BUFFER_SIZE];
+	uint32			entry_count;
+	pthread_rwlock_t	lock;
+	std::atomic<bool>	stop;
+};
+
+typedef struct perf_reader_s {
+	ih_hndlr_t		hndlr;
+	pthread_rwlock_t*	lock;
+	uint32			entry_count;
+	uint32			found;
+} perf_reader_t;
+
+typedef struct perf_writer_s {
+	ih_hndlr_t		hndlr;
+	pthread_rwlock_t*	lock;
+	uint32			entry_count;
+	std::atomic<bool>*	stop;
+	uint32			updates;
+} perf_writer_t;
+
+void* perf_reader (void* arg) {
+	perf_reader_t* rd = (perf_reader_t *) arg;
+	uint16* value = 0;
+	uint32 i;
+	for (i = 0; i < PERF_SEARCH_COUNT; i++) {
+		void* key = (void*) ((char *)0xFFFF + (i % rd->entry_count));
+		pthread_rwlock_rdlock(rd->lock);
+		if (ih_hash8_search(rd->hndlr, (const char *) &key, 0, (char**)&value) == IH_ERR_SUCCESS)
+			rd->found++;
+		pthread_rwlock_unlock(rd->lock);
+	}
+	return NULL;
+}
+
+void* perf_writer (void* arg) {
+	perf_writer_t* wr = (perf_writer_t *) arg;
+	uint16* value = 0;
+	void* key = (void*) ((char *)0xFFFF + wr->entry_count);
+	while (!wr->stop->load()) {
+		pthread_rwlock_wrlock(wr->lock);
+		if ((ih_hash8_add(wr->hndlr, (const char *) &key, 0, (char**)&value, 0) == IH_ERR_SUCCESS)
+			&& (ih_hash8_remove(wr->hndlr, (const char *) &key, 0) == IH_ERR_SUCCESS))
+			wr->updates++;
+		pthread_rwlock_unlock(wr->lock);
+		usleep(100);
+	}
+	return NULL;
+}
+
+TEST_F(IdxHashPerfClass, ReadersScaling)
+{
+	uint32 readers_max = sysconf(_SC_NPROCESSORS_ONLN);
+	if (readers_max > PERF_READERS_MAX)
+		readers_max = PERF_READERS_MAX;
+
+	uint32 readers;
+	for (readers = 1; readers <= readers_max; readers++) {
+		pthread_t rd_threads[PERF_READERS_MAX];
+		perf_reader_t rd_args[PERF_READERS_MAX];
+		pthread_t wr_thread;
+		perf_writer_t wr_arg = { hndlr, &lock, entry_count, &stop, 0 };
+
+		stop = false;
+		ASSERT_EQ(pthread_create(&wr_thread, NULL, perf_writer, &wr_arg), 0);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		uint32 created;
+		for (created = 0; created < readers; created++) {
+			perf_reader_t rd = { hndlr, &lock, entry_count, 0 };
+			rd_args[created] = rd;
+			if (pthread_create(&rd_threads[created], NULL, perf_reader, &rd_args[created]) != 0)
+				break;
+		}
+		uint32 i;
+		for (i = 0; i < created; i++)
+			pthread_join(rd_threads[i], NULL);
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// the writer must be gone before TearDown destroys the lock
+		stop = true;
+		pthread_join(wr_thread, NULL);
+		ASSERT_EQ(created, readers);
+		// otherwise the figures are reader-only
+		ASSERT_GT(wr_arg.updates, 0);
+
+		for (i = 0; i < readers; i++)
+			ASSERT_EQ(rd_args[i].found, PERF_SEARCH_COUNT);
+
+		printf("idxhash readers: %u, searches: %u, elapsed: %.3f s, rate: %.0f ops/s, writer updates: %u\n",
+			readers, readers * PERF_SEARCH_COUNT, elapsed, readers * PERF_SEARCH_COUNT / elapsed, wr_arg.updates);
+	}
+}
+
+#define PERF_ROUNDS		1000
+#define PERF_KEY_SIZE		16
+
+void forall_count (const char *key, ih_size_t keylen, const char *value, ih_size_t valuelen, void * data) {
+	(*(uint32 *) data)++;
+}
+
+class IdxHashOpsPerfClass : public ::testing::Test {
+protected:
+	void SetUp()
+	{
+		keys = NULL;
+	}
+	void TearDown()
+	{
+		if (keys)
+			os_free(keys);
+	}
+
+	void Init()
+	{
+		ASSERT_EQ(ih_init8(buf, sizeof(buf), 255, keylen, 2, &hndlr), IH_ERR_SUCCESS);
+	}
+
+	size_t KeySize()
+	{
+		return keylen ? sizeof(void*) : PERF_KEY_SIZE;
+	}
+
+	void MakeKey(uint32 i, char* key)
+	{
+		if (keylen) {
+			void* keyptr = (void*) ((char *)0xFFFF + i);
+			os_memcpy(key, &keyptr, sizeof(keyptr));
+		}
+		else
+			snprintf(key, PERF_KEY_SIZE, "key_%u", i);
+	}
+
+	void Capacity(uint32* capacity)
+	{
+		char key[PERF_KEY_SIZE];
+		uint16* value = 0;
+		ASSERT_NO_FATAL_FAILURE(Init());
+		*capacity = 0;
+		while (true) {
+			MakeKey(*capacity, key);
+			if (ih_hash8_add(hndlr, key, 0, (char**)&value, 0) != IH_ERR_SUCCESS)
+				break;
+			(*capacity)++;
+		}
+	}
+
+	void Run(const char* mode, ih_size_t key_length)
+	{
+		keylen = key_length;
+		uint32 capacity;
+		ASSERT_NO_FATAL_FAILURE(Capacity(&capacity));
+		ASSERT_GT(capacity, 0);
+		size_t keysize = KeySize();
+		// keys 0..capacity-1 are inserted, capacity..2*capacity-1 are misses
+		keys = (char*)os_malloc(2 * capacity * keysize);
+		ASSERT_TRUE(keys != NULL);
+		uint32 i, r;
+		for (i = 0; i < 2 * capacity; i++)
+			MakeKey(i, keys + i * keysize);
+
+		uint32 load;
+		for (load = 25; load <= 100; load += 25) {
+			uint32 count = capacity * load / 100;
+			double t_add = 0, t_hit = 0, t_miss = 0, t_forall = 0, t_remove = 0;
+			uint16* value = 0;
+			for (r = 0; r < PERF_ROUNDS; r++) {
+				uint32 added = 0, hits = 0, misses = 0, visited = 0, removed = 0;
+				ASSERT_NO_FATAL_FAILURE(Init());
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				for (i = 0; i < count; i++)
+					if (ih_hash8_add(hndlr, keys + i * keysize, 0, (char**)&value, 0) == IH_ERR_SUCCESS)
+						added++;
+				std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+				t_add += std::chrono::duration<double>(stop - start).count();
+
+				start = stop;
+				for (i = 0; i < count; i++)
+					if (ih_hash8_search(hndlr, keys + i * keysize, 0, (char**)&value) == IH_ERR_SUCCESS)
+						hits++;
+				stop = std::chrono::steady_clock::now();
+				t_hit += std::chrono::duration<double>(stop - start).count();
+
+				start = stop;
+				for (i = 0; i < count; i++)
+					if (ih_hash8_search(hndlr, keys + (capacity + i) * keysize, 0, (char**)&value) != IH_ERR_SUCCESS)
+						misses++;
+				stop = std::chrono::steady_clock::now();
+				t_miss += std::chrono::duration<double>(stop - start).count();
+
+				start = stop;
+				ih_hash8_forall(hndlr, forall_count, (void *) &visited);
+				stop = std::chrono::steady_clock::now();
+				t_forall += std::chrono::duration<double>(stop - start).count();
+
+				start = stop;
+				for (i = 0; i < count; i++)
+					if (ih_hash8_remove(hndlr, keys + i * keysize, 0) == IH_ERR_SUCCESS)
+						removed++;
+				stop = std::chrono::steady_clock::now();
+				t_remove += std::chrono::duration<double>(stop - start).count();
+
+				ASSERT_EQ(added, count);
+				ASSERT_EQ(hits, count);
+				ASSERT_EQ(misses, count);
+				ASSERT_EQ(visited, count);
+				ASSERT_EQ(removed, count);
+			}
+
+			double ops = (double) count * PERF_ROUNDS / 1e9;
+			printf("idxhash key: %s, load: %u%%, entries: %u/%u, ns/op add: %.1f, hit: %.1f, miss: %.1f, remove: %.1f, forall: %.1f\n",
+				mode, load, count, capacity, t_add / ops, t_hit / ops, t_miss / ops, t_remove / ops, t_forall / ops);
+		}
+	}
+
+	ih_hndlr_t	hndlr;
+	ih_size_t	keylen;
+	char*		keys;
+	char		buf[PERF_BUFFER_SIZE];
+};
+
+TEST_F(IdxHashOpsPerfClass, NullTermKey)
+{
+	Run("null-terminated", 0);
+}
+
+TEST_F(IdxHashOpsPerfClass, FixedKey)
+{
+	Run("fixed", sizeof(void*));
+}
+#endif
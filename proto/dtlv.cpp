@@ -1,4 +1,5 @@
 #include "gtest/gtest.h"
+#include <chrono>
 
 extern "C" {
 	#include "proto/dtlv.h"
@@ -6,6 +7,8 @@ extern "C" {
 	#include "core/utils.h"
 }
 
+#include "proto/dtlv_bind.hpp"
+
 
 class DtlvClass : public ::testing::Test {
 protected:
@@ -235,4 +238,441 @@ TEST_F(DtlvClass, DecodeByPath)
 	ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx, buffer, dtlv_ctx.datalen), DTLV_ERR_SUCCESS);
 	ASSERT_EQ(dtlv_avp_decode_bypath(&dtlv_ctx, path2, avp_array, 1, true, &total_count), DTLV_FORALL_BREAK);
 	ASSERT_EQ(total_count, 1);
-}
\ No newline at end of file
+}
+
+
+typedef struct bind_inner_s {
+	uint8		x;
+	uint16		y;
+} bind_inner_t;
+
+typedef struct bind_outer_s {
+	uint8		a;
+	uint16		b;
+	uint32		c;
+	char		name[16];
+	uint8		digest[4];
+	bind_inner_t	inner;
+} bind_outer_t;
+
+typedef dtlv_bind::object<
+	DTLV_BIND_FIELD(bind_inner_t, x, 1),
+	DTLV_BIND_FIELD(bind_inner_t, y, 2)
+> bind_inner_bind_t;
+
+DTLV_BIND_GROUPING(bind_inner_t, bind_inner_bind_t)
+
+typedef dtlv_bind::object<
+	DTLV_BIND_FIELD(bind_outer_t, a, 1),
+	DTLV_BIND_FIELD(bind_outer_t, b, 2),
+	DTLV_BIND_FIELD(bind_outer_t, c, 3),
+	DTLV_BIND_FIELD(bind_outer_t, name, 4),
+	DTLV_BIND_FIELD(bind_outer_t, digest, 5),
+	DTLV_BIND_FIELD(bind_outer_t, inner, 6)
+> bind_outer_bind_t;
+
+dtlv_errcode_t bind_outer_encode_manual(dtlv_ctx_t* ctx, const bind_outer_t* obj)
+{
+	dtlv_errcode_t res;
+	if ((res = dtlv_avp_encode_uint8(ctx, 1, obj->a)) != DTLV_ERR_SUCCESS)
+		return res;
+	if ((res = dtlv_avp_encode_uint16(ctx, 2, obj->b)) != DTLV_ERR_SUCCESS)
+		return res;
+	if ((res = dtlv_avp_encode_uint32(ctx, 3, obj->c)) != DTLV_ERR_SUCCESS)
+		return res;
+	if ((res = dtlv_avp_encode_char(ctx, 4, obj->name)) != DTLV_ERR_SUCCESS)
+		return res;
+	if ((res = dtlv_avp_encode_octets(ctx, 5, sizeof(obj->digest), (const char *) obj->digest)) != DTLV_ERR_SUCCESS)
+		return res;
+	dtlv_avp_t* gavp;
+	if ((res = dtlv_avp_encode_grouping(ctx, 0, 6, &gavp)) != DTLV_ERR_SUCCESS)
+		return res;
+	if ((res = dtlv_avp_encode_uint8(ctx, 1, obj->inner.x)) != DTLV_ERR_SUCCESS)
+		return res;
+	if ((res = dtlv_avp_encode_uint16(ctx, 2, obj->inner.y)) != DTLV_ERR_SUCCESS)
+		return res;
+	return dtlv_avp_encode_group_done(ctx, gavp);
+}
+
+TEST_F(DtlvClass, BindingEncodingDecoding)
+{
+	char buf[512];
+	const char* resjson = "{\"1\":240,\"2\":65520,\"3\":4294967280,\"4\":\"test_octets_avp\",\"5\":\"01020304\",\"6\":{\"1\":241,\"2\":65521}}";
+	bind_outer_t obj = { 0xF0, 0xFFF0, 0xFFFFFFF0, "test_octets_avp", { 1, 2, 3, 4 }, { 0xF1, 0xFFF1 } };
+
+	dtlv_ctx_t dtlv_ctx;
+	ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx, buffer, buflen), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(bind_outer_bind_t::encode(&dtlv_ctx, obj), DTLV_ERR_SUCCESS);
+
+	char manual[512];
+	dtlv_ctx_t dtlv_ctx2;
+	ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx2, manual, sizeof(manual)), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(bind_outer_encode_manual(&dtlv_ctx2, &obj), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(dtlv_ctx.datalen, dtlv_ctx2.datalen);
+	ASSERT_EQ(memcmp(buffer, manual, dtlv_ctx.datalen), 0);
+
+	ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx2, buffer, dtlv_ctx.datalen), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(dtlv_decode_to_json(&dtlv_ctx2, buf), DTLV_ERR_SUCCESS);
+	ASSERT_STREQ(buf, resjson);
+
+	bind_outer_t obj2;
+	os_memset(&obj2, 0, sizeof(obj2));
+	ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx2, buffer, dtlv_ctx.datalen), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(bind_outer_bind_t::decode(&dtlv_ctx2, obj2), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(obj2.a, obj.a);
+	ASSERT_EQ(obj2.b, obj.b);
+	ASSERT_EQ(obj2.c, obj.c);
+	ASSERT_STREQ(obj2.name, obj.name);
+	ASSERT_EQ(memcmp(obj2.digest, obj.digest, sizeof(obj.digest)), 0);
+	ASSERT_EQ(obj2.inner.x, obj.inner.x);
+	ASSERT_EQ(obj2.inner.y, obj.inner.y);
+
+	// type mismatch
+	ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx, buffer, buflen), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(dtlv_avp_encode_char(&dtlv_ctx, 3, "abc"), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx2, buffer, dtlv_ctx.datalen), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(bind_outer_bind_t::decode(&dtlv_ctx2, obj2), DTLV_AVP_INV_TYPE);
+
+	// char field without terminator
+	os_memset(obj2.name, 'x', sizeof(obj2.name));
+	ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx, buffer, buflen), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(bind_outer_bind_t::encode(&dtlv_ctx, obj2), DTLV_AVP_INVALID_LEN);
+}
+
+#ifdef PERF_TEST
+#define PERF_ROUNDS		1000
+/* dtlv_decode_to_json takes no output length: the buffer is deliberately
+   oversized, well above the expansion of a 64KB message (hex octets, short
+   integer AVPs), so the length checks after decoding are a sanity check only */
+#define PERF_JSON_SIZE		(4*65536)
+
+void perf_encode_wide(dtlv_ctx_t* ctx, uint16 count)
+{
+	const char* stravp = "test_octets_avp";
+	uint16 i;
+	for (i = 0; i < count; i++) {
+		switch (i % 3) {
+		case 0:
+			ASSERT_EQ(dtlv_avp_encode_uint32(ctx, 1 + i % 64, 0xFFFFFFF0 - i), DTLV_ERR_SUCCESS);
+			break;
+		case 1:
+			ASSERT_EQ(dtlv_avp_encode_char(ctx, 1 + i % 64, stravp), DTLV_ERR_SUCCESS);
+			break;
+		default:
+			ASSERT_EQ(dtlv_avp_encode_octets(ctx, 1 + i % 64, os_strlen(stravp), stravp), DTLV_ERR_SUCCESS);
+		}
+	}
+}
+
+void perf_encode_deep(dtlv_ctx_t* ctx, uint8 depth)
+{
+	ASSERT_EQ(dtlv_avp_encode_uint8(ctx, 1, 0xF0), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(dtlv_avp_encode_uint16(ctx, 2, 0xFFF0), DTLV_ERR_SUCCESS);
+	ASSERT_EQ(dtlv_avp_encode_uint32(ctx, 3, 0xFFFFFFF0), DTLV_ERR_SUCCESS);
+	if (depth) {
+		dtlv_avp_t* gavp;
+		ASSERT_EQ(dtlv_avp_encode_grouping(ctx, 0, 10, &gavp), DTLV_ERR_SUCCESS);
+		perf_encode_deep(ctx, depth - 1);
+		ASSERT_EQ(dtlv_avp_encode_group_done(ctx, gavp), DTLV_ERR_SUCCESS);
+	}
+}
+
+void perf_encode_lists(dtlv_ctx_t* ctx, uint16 count, uint16 length)
+{
+	uint16 i, j;
+	for (i = 0; i < count; i++) {
+		dtlv_avp_t* gavp;
+		ASSERT_EQ(dtlv_avp_encode_list(ctx, 0, 20, DTLV_TYPE_INTEGER, &gavp), DTLV_ERR_SUCCESS);
+		for (j = 0; j < length; j++)
+			ASSERT_EQ(dtlv_avp_encode_uint32(ctx, 20, 0xFFFFFFF0 - j), DTLV_ERR_SUCCESS);
+		ASSERT_EQ(dtlv_avp_encode_group_done(ctx, gavp), DTLV_ERR_SUCCESS);
+	}
+}
+
+void perf_encode_octets(dtlv_ctx_t* ctx, uint16 count, dtlv_size_t length, const char* data)
+{
+	uint16 i;
+	for (i = 0; i < count; i++) {
+		ASSERT_EQ(dtlv_avp_encode_uint16(ctx, 4, i), DTLV_ERR_SUCCESS);
+		ASSERT_EQ(dtlv_avp_encode_octets(ctx, 5, length, data), DTLV_ERR_SUCCESS);
+	}
+}
+
+dtlv_errcode_t perf_decode_walk(dtlv_ctx_t* ctx, uint32* count)
+{
+	dtlv_davp_t avp;
+	dtlv_errcode_t res;
+	while ((res = dtlv_avp_decode(ctx, &avp)) == DTLV_ERR_SUCCESS) {
+		(*count)++;
+		if ((avp.havpd.datatype == DTLV_TYPE_OBJECT) || avp.havpd.is_list) {
+			dtlv_ctx_t dtlv_ctx2;
+			dtlv_ctx_init_decode(&dtlv_ctx2, avp.avp->data, d_avp_data_length(avp.havpd.length));
+			if ((res = perf_decode_walk(&dtlv_ctx2, count)) != DTLV_ERR_SUCCESS)
+				return res;
+		}
+	}
+	return (res == DTLV_END_OF_DATA) ? DTLV_ERR_SUCCESS : res;
+}
+
+typedef enum perf_shape_e {
+	PERF_SHAPE_FLAT		= 0,
+	PERF_SHAPE_NESTED	= 1,
+	PERF_SHAPE_LISTS	= 2,
+	PERF_SHAPE_OCTETS	= 3,
+	PERF_SHAPE_MAX		= 4,
+} perf_shape_t;
+
+const char* perf_shape_name[PERF_SHAPE_MAX] = { "flat", "nested", "lists", "octets" };
+
+class DtlvPerfClass : public ::testing::Test {
+protected:
+	void SetUp()
+	{
+		buflen = 65535;
+		buffer = (char*)os_malloc(buflen);
+		json = (char*)os_malloc(PERF_JSON_SIZE);
+		ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx, buffer, buflen), DTLV_ERR_SUCCESS);
+	}
+
+	void TearDown()
+	{
+		os_free(buffer);
+		os_free(json);
+	}
+
+	void PerfJson(const char* shape)
+	{
+		dtlv_size_t datalen = dtlv_ctx.datalen;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		uint32 r;
+		for (r = 0; r < PERF_ROUNDS; r++) {
+			ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx, buffer, datalen), DTLV_ERR_SUCCESS);
+			ASSERT_EQ(dtlv_decode_to_json(&dtlv_ctx, json), DTLV_ERR_SUCCESS);
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		size_t jsonlen = os_strlen(json);
+		// sanity check only, an overflow would already have happened
+		ASSERT_LT(jsonlen, PERF_JSON_SIZE);
+
+		Report("json", shape, datalen, PERF_ROUNDS, elapsed, jsonlen);
+	}
+
+	void Encode(perf_shape_t shape)
+	{
+		ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx, buffer, buflen), DTLV_ERR_SUCCESS);
+		int i;
+		switch (shape) {
+		case PERF_SHAPE_FLAT:
+			perf_encode_wide(&dtlv_ctx, 2000);
+			break;
+		case PERF_SHAPE_NESTED:
+			for (i = 0; i < 64; i++)
+				perf_encode_deep(&dtlv_ctx, 12);
+			break;
+		case PERF_SHAPE_LISTS:
+			perf_encode_lists(&dtlv_ctx, 6, 1000);
+			break;
+		default:
+			perf_encode_octets(&dtlv_ctx, 6, sizeof(octets), octets);
+		}
+	}
+
+	void Report(const char* op, const char* shape, dtlv_size_t datalen, uint32 rounds, double elapsed, size_t outlen = 0)
+	{
+		printf("{\"bench\":\"dtlv\",\"op\":\"%s\",\"shape\":\"%s\",\"bytes\":%u,\"rounds\":%u,\"msg_per_sec\":%.0f,\"mb_per_sec\":%.2f",
+			op, shape, datalen, rounds, rounds / elapsed, (double) datalen * rounds / elapsed / 1e6);
+		if (outlen)
+			printf(",\"out_bytes\":%u,\"out_mb_per_sec\":%.2f", (uint32) outlen, (double) outlen * rounds / elapsed / 1e6);
+		printf("}\n");
+	}
+
+	char*		buffer;
+	char*		json;
+	dtlv_size_t	buflen;
+	dtlv_ctx_t	dtlv_ctx;
+	char		octets[8000];
+};
+
+TEST_F(DtlvPerfClass, JsonWide)
+{
+	perf_encode_wide(&dtlv_ctx, 2000);
+	PerfJson("wide");
+}
+
+TEST_F(DtlvPerfClass, JsonDeep)
+{
+	int i;
+	for (i = 0; i < 64; i++)
+		perf_encode_deep(&dtlv_ctx, 12);
+	PerfJson("deep");
+}
+
+
+TEST_F(DtlvPerfClass, Throughput)
+{
+	dtlv_nscode_t paths[PERF_SHAPE_MAX][4] = {
+		{ {0, 1}, {0, 0} },
+		{ {0, 10}, {0, 10}, {0, 3}, {0, 0} },
+		{ {0, 20}, {0, 0} },
+		{ {0, 5}, {0, 0} },
+	};
+	dtlv_davp_t avp_array[16];
+	uint16 total_count;
+	os_memset(octets, 0xA5, sizeof(octets));
+
+	int shape;
+	for (shape = 0; shape < PERF_SHAPE_MAX; shape++) {
+		uint32 r;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (r = 0; r < PERF_ROUNDS; r++)
+			Encode((perf_shape_t) shape);
+		Report("encode", perf_shape_name[shape], dtlv_ctx.datalen, PERF_ROUNDS,
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+		dtlv_size_t datalen = dtlv_ctx.datalen;
+		uint32 count = 0;
+		start = std::chrono::steady_clock::now();
+		for (r = 0; r < PERF_ROUNDS; r++) {
+			ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx, buffer, datalen), DTLV_ERR_SUCCESS);
+			ASSERT_EQ(perf_decode_walk(&dtlv_ctx, &count), DTLV_ERR_SUCCESS);
+		}
+		Report("decode", perf_shape_name[shape], datalen, PERF_ROUNDS,
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+		start = std::chrono::steady_clock::now();
+		for (r = 0; r < PERF_ROUNDS; r++) {
+			ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx, buffer, datalen), DTLV_ERR_SUCCESS);
+			ASSERT_EQ(dtlv_avp_decode_bypath(&dtlv_ctx, paths[shape], avp_array, 16, false, &total_count), DTLV_ERR_SUCCESS);
+		}
+		Report("bypath", perf_shape_name[shape], datalen, PERF_ROUNDS,
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+		Encode((perf_shape_t) shape);
+		PerfJson(perf_shape_name[shape]);
+	}
+}
+
+/* Hand-written equivalent of the binding decoders, with the same checks */
+dtlv_errcode_t bind_inner_decode_manual(dtlv_ctx_t* ctx, bind_inner_t* obj)
+{
+	dtlv_davp_t avp;
+	dtlv_errcode_t res;
+	while ((res = dtlv_avp_decode(ctx, &avp)) == DTLV_ERR_SUCCESS) {
+		if (avp.havpd.nscode.comp.namespace_id != 0)
+			continue;
+		switch (avp.havpd.nscode.comp.code) {
+		case 1:
+			if (avp.havpd.datatype != DTLV_TYPE_INTEGER)
+				return DTLV_AVP_INV_TYPE;
+			res = dtlv_avp_get_uint8(&avp, &obj->x);
+			break;
+		case 2:
+			if (avp.havpd.datatype != DTLV_TYPE_INTEGER)
+				return DTLV_AVP_INV_TYPE;
+			res = dtlv_avp_get_uint16(&avp, &obj->y);
+			break;
+		}
+		if (res != DTLV_ERR_SUCCESS)
+			return res;
+	}
+	return (res == DTLV_END_OF_DATA) ? DTLV_ERR_SUCCESS : res;
+}
+
+dtlv_errcode_t bind_outer_decode_manual(dtlv_ctx_t* ctx, bind_outer_t* obj)
+{
+	dtlv_davp_t avp;
+	dtlv_errcode_t res;
+	while ((res = dtlv_avp_decode(ctx, &avp)) == DTLV_ERR_SUCCESS) {
+		if (avp.havpd.nscode.comp.namespace_id != 0)
+			continue;
+		switch (avp.havpd.nscode.comp.code) {
+		case 1:
+			if (avp.havpd.datatype != DTLV_TYPE_INTEGER)
+				return DTLV_AVP_INV_TYPE;
+			res = dtlv_avp_get_uint8(&avp, &obj->a);
+			break;
+		case 2:
+			if (avp.havpd.datatype != DTLV_TYPE_INTEGER)
+				return DTLV_AVP_INV_TYPE;
+			res = dtlv_avp_get_uint16(&avp, &obj->b);
+			break;
+		case 3:
+			if (avp.havpd.datatype != DTLV_TYPE_INTEGER)
+				return DTLV_AVP_INV_TYPE;
+			res = dtlv_avp_get_uint32(&avp, &obj->c);
+			break;
+		case 4:
+			{
+				if (avp.havpd.datatype != DTLV_TYPE_CHAR)
+					return DTLV_AVP_INV_TYPE;
+				size_t slen = strnlen(avp.avp->data, d_avp_data_length(avp.havpd.length));
+				if (slen >= sizeof(obj->name))
+					return DTLV_AVP_INVALID_LEN;
+				os_memcpy(obj->name, avp.avp->data, slen);
+				obj->name[slen] = '\0';
+			}
+			break;
+		case 5:
+			if (avp.havpd.datatype != DTLV_TYPE_OCTETS)
+				return DTLV_AVP_INV_TYPE;
+			if (d_avp_data_length(avp.havpd.length) != sizeof(obj->digest))
+				return DTLV_AVP_INVALID_LEN;
+			os_memcpy(obj->digest, avp.avp->data, sizeof(obj->digest));
+			break;
+		case 6:
+			{
+				if (avp.havpd.datatype != DTLV_TYPE_OBJECT)
+					return DTLV_AVP_INV_TYPE;
+				dtlv_ctx_t dtlv_ctx2;
+				res = dtlv_ctx_init_decode(&dtlv_ctx2, avp.avp->data, d_avp_data_length(avp.havpd.length));
+				if (res == DTLV_ERR_SUCCESS)
+					res = bind_inner_decode_manual(&dtlv_ctx2, &obj->inner);
+			}
+			break;
+		}
+		if (res != DTLV_ERR_SUCCESS)
+			return res;
+	}
+	return (res == DTLV_END_OF_DATA) ? DTLV_ERR_SUCCESS : res;
+}
+
+TEST_F(DtlvPerfClass, BindingVsManual)
+{
+	bind_outer_t obj = { 0xF0, 0xFFF0, 0xFFFFFFF0, "test_octets_avp", { 1, 2, 3, 4 }, { 0xF1, 0xFFF1 } };
+	bind_outer_t obj2;
+	uint32 r;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (r = 0; r < PERF_ROUNDS * 100; r++) {
+		ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx, buffer, buflen), DTLV_ERR_SUCCESS);
+		ASSERT_EQ(bind_outer_encode_manual(&dtlv_ctx, &obj), DTLV_ERR_SUCCESS);
+	}
+	double t_enc_manual = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for (r = 0; r < PERF_ROUNDS * 100; r++) {
+		ASSERT_EQ(dtlv_ctx_init_encode(&dtlv_ctx, buffer, buflen), DTLV_ERR_SUCCESS);
+		ASSERT_EQ(bind_outer_bind_t::encode(&dtlv_ctx, obj), DTLV_ERR_SUCCESS);
+	}
+	double t_enc_bind = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	dtlv_size_t datalen = dtlv_ctx.datalen;
+	start = std::chrono::steady_clock::now();
+	for (r = 0; r < PERF_ROUNDS * 100; r++) {
+		ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx, buffer, datalen), DTLV_ERR_SUCCESS);
+		ASSERT_EQ(bind_outer_decode_manual(&dtlv_ctx, &obj2), DTLV_ERR_SUCCESS);
+	}
+	double t_dec_manual = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for (r = 0; r < PERF_ROUNDS * 100; r++) {
+		ASSERT_EQ(dtlv_ctx_init_decode(&dtlv_ctx, buffer, datalen), DTLV_ERR_SUCCESS);
+		ASSERT_EQ(bind_outer_bind_t::decode(&dtlv_ctx, obj2), DTLV_ERR_SUCCESS);
+	}
+	double t_dec_bind = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double ops = (double) PERF_ROUNDS * 100 / 1e9;
+	printf("dtlv binding ns/msg encode manual: %.1f, bind: %.1f, decode manual: %.1f, bind: %.1f\n",
+		t_enc_manual / ops, t_enc_bind / ops, t_dec_manual / ops, t_dec_bind / ops);
+}
+#endif
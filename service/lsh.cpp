@@ -1,4 +1,5 @@
 #include "gtest/gtest.h"
+#include <chrono>
 
 extern "C" {
 	#include "system/imdb.h"
@@ -255,4 +256,248 @@ TEST_F(LshClass, ComplexStatement)
 	imdb_info_t imdb_inf;
 	imdb_class_info_t info_array[10];
 	imdb_info(hmdb, &imdb_inf, &info_array[0], 10);
-}
\ No newline at end of file
+}
+
+#ifdef PERF_TEST
+#define PERF_STMT_COUNT		10000
+#define PERF_STMT_LENGTH	256
+
+const char* perf_stmt_template[] = {
+	"2*((2*4 + %u) + 3) + 7",
+	"# var1 := %u; func1( var1 )",
+	"func3( %u, \"abc\", 10 )",
+	"(2 < %u) ?? { 4*5 } : { 6-7; }",
+	"# sdt := sysdate(); # var1 := %u; ((var1 <= 2) & (sdt + 600 < var1)) ?? { gpio_set(4, 0); var1 := 4 };",
+};
+
+#define PERF_SOURCE_LENGTH	8192
+#define PERF_SOURCE_COUNT	32
+#define PERF_PARSE_ROUNDS	100
+
+/* Same statement mix without declarations, so it may be repeated within one source */
+const char* perf_batch_prologue = "# var1 := 0; # sdt := 0";
+const char* perf_batch_template[] = {
+	"2*((2*4 + %u) + 3) + 7",
+	"var1 := %u; func1( var1 )",
+	"func3( %u, \"abc\", 10 )",
+	"(2 < %u) ?? { 4*5 } : { 6-7; }",
+	"sdt := sysdate(); var1 := %u; ((var1 <= 2) & (sdt + 600 < var1)) ?? { gpio_set(4, 0); var1 := 4 }",
+};
+
+class LshPerfClass : public LshClass {
+protected:
+	const char* Source(uint32 i)
+	{
+		const char* tmpl = perf_stmt_template[i % (sizeof(perf_stmt_template) / sizeof(perf_stmt_template[0]))];
+		snprintf(src, sizeof(src), tmpl, i);
+		return src;
+	}
+
+	/* Joins statements with ';' while the bytecode still fits the parser buffer */
+	sh_errcode_t Batch(char* batch, uint32* next)
+	{
+		size_t len = os_strlen(perf_batch_prologue);
+		os_memcpy(batch, perf_batch_prologue, len + 1);
+		while (true) {
+			const char* tmpl = perf_batch_template[*next % (sizeof(perf_batch_template) / sizeof(perf_batch_template[0]))];
+			snprintf(src, sizeof(src), tmpl, *next);
+			size_t slen = os_strlen(src);
+			if (len + slen + 2 > PERF_SOURCE_LENGTH)
+				return SH_ERR_SUCCESS;
+			batch[len] = ';';
+			os_memcpy(batch + len + 1, src, slen + 1);
+
+			sh_hndlr_t hprobe;
+			sh_errcode_t res = stmt_parse(batch, "", &hprobe);
+			if (res == SH_PARSE_ERROR_OUTOFBUF) {
+				batch[len] = '\0';
+				return SH_ERR_SUCCESS;
+			}
+			if (res != SH_ERR_SUCCESS)
+				return res;
+			stmt_free(hprobe);
+			len += slen + 1;
+			(*next)++;
+		}
+	}
+
+	char	src[PERF_STMT_LENGTH];
+};
+
+TEST_F(LshPerfClass, ParseThroughput)
+{
+	char* batch = (char*)os_malloc(PERF_SOURCE_COUNT * PERF_SOURCE_LENGTH);
+	ASSERT_TRUE(batch != NULL);
+	sh_errcode_t batch_res = SH_ERR_SUCCESS;
+	size_t total_len = 0;
+	uint32 stmt_count = 0;
+	uint32 i;
+	for (i = 0; i < PERF_SOURCE_COUNT; i++) {
+		batch_res = Batch(batch + i * PERF_SOURCE_LENGTH, &stmt_count);
+		if (batch_res != SH_ERR_SUCCESS)
+			break;
+		total_len += os_strlen(batch + i * PERF_SOURCE_LENGTH);
+	}
+	if (batch_res != SH_ERR_SUCCESS) {
+		os_free(batch);
+		ASSERT_EQ(batch_res, SH_ERR_SUCCESS);
+	}
+
+	double elapsed = 0;
+	uint32 success = 0;
+	uint32 r;
+	for (r = 0; r < PERF_PARSE_ROUNDS; r++) {
+		for (i = 0; i < PERF_SOURCE_COUNT; i++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			sh_errcode_t res = stmt_parse(batch + i * PERF_SOURCE_LENGTH, "", &hstmt);
+			elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (res == SH_ERR_SUCCESS) {
+				success++;
+				stmt_free(hstmt);
+			}
+		}
+	}
+	os_free(batch);
+	ASSERT_EQ(success, PERF_PARSE_ROUNDS * PERF_SOURCE_COUNT);
+
+	printf("lsh parse sources: %u, statements: %u, source: %u bytes (avg %u), rate: %.0f stmt/s, %.2f MB/s\n",
+		PERF_SOURCE_COUNT, stmt_count, (uint32) total_len, (uint32) (total_len / PERF_SOURCE_COUNT),
+		stmt_count * PERF_PARSE_ROUNDS / elapsed, total_len * PERF_PARSE_ROUNDS / elapsed / 1e6);
+
+	total_len = 0;
+	elapsed = 0;
+	for (i = 0; i < PERF_STMT_COUNT; i++) {
+		const char* stmt = Source(i);
+		total_len += os_strlen(stmt);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ASSERT_EQ(stmt_parse(stmt, "", &hstmt), SH_ERR_SUCCESS);
+		elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		stmt_free(hstmt);
+	}
+
+	printf("lsh parse statements: %u, source: %u bytes, rate: %.0f stmt/s, %.2f MB/s\n",
+		PERF_STMT_COUNT, (uint32) total_len, PERF_STMT_COUNT / elapsed, total_len / elapsed / 1e6);
+}
+
+TEST_F(LshPerfClass, ResidentMemory)
+{
+	/* statements are stored as IMDB objects: record header, bytecode and page overhead */
+	imdb_info_t imdb_before;
+	ASSERT_EQ(imdb_info(hmdb, &imdb_before, NULL, 0), IMDB_ERR_SUCCESS);
+
+	sh_hndlr_t* hstmts = (sh_hndlr_t*)os_malloc(PERF_STMT_COUNT * sizeof(sh_hndlr_t));
+	ASSERT_TRUE(hstmts != NULL);
+	uint32 total_bytes = 0;
+	uint32 min_bytes = 0xFFFFFFFF;
+	uint32 max_bytes = 0;
+	sh_errcode_t parse_res = SH_ERR_SUCCESS;
+	sh_errcode_t info_res = SH_ERR_SUCCESS;
+	uint32 count;
+	for (count = 0; count < PERF_STMT_COUNT; count++) {
+		parse_res = stmt_parse(Source(count), "", &hstmts[count]);
+		if (parse_res != SH_ERR_SUCCESS)
+			break;
+
+		sh_stmt_info_t info;
+		info_res = stmt_info(hstmts[count], &info);
+		if (info_res != SH_ERR_SUCCESS) {
+			stmt_free(hstmts[count]);
+			break;
+		}
+		total_bytes += info.length;
+		if (info.length < min_bytes)
+			min_bytes = info.length;
+		if (info.length > max_bytes)
+			max_bytes = info.length;
+	}
+
+	imdb_info_t imdb_after;
+	imdb_errcode_t imdb_res = imdb_info(hmdb, &imdb_after, NULL, 0);
+
+	uint32 i;
+	for (i = 0; i < count; i++)
+		stmt_free(hstmts[i]);
+	os_free(hstmts);
+
+	ASSERT_EQ(imdb_res, IMDB_ERR_SUCCESS);
+	ASSERT_EQ(info_res, SH_ERR_SUCCESS);
+	/* running out of heap ends the load early, any other error is a failure */
+	if (count < PERF_STMT_COUNT) {
+		ASSERT_EQ(parse_res, SH_ALLOCATION_ERROR);
+	}
+	ASSERT_GT(count, 0);
+
+	size_t resident = (imdb_after.stat.mem_alloc - imdb_after.stat.mem_free)
+		- (imdb_before.stat.mem_alloc - imdb_before.stat.mem_free);
+	printf("lsh loaded statements: %u/%u, bytecode: %u bytes, per statement avg: %u, min: %u, max: %u\n",
+		count, PERF_STMT_COUNT, total_bytes, total_bytes / count, min_bytes, max_bytes);
+	printf("lsh resident imdb: %u bytes, per statement: %u\n",
+		(uint32) resident, (uint32) (resident / count));
+}
+
+#define PERF_EVAL_ROUNDS	100000
+
+/* Stub natives: no side effects, so the figures cover the executor only */
+void perf_fn_stub(sh_eval_ctx_t* ctx, sh_bc_arg_t* ret_arg, const arg_count_t arg_count, sh_bc_arg_type_t* arg_type, sh_bc_arg_t** args)
+{
+	ret_arg->arg.value = (arg_count > 0 && arg_type[0] == SH_BC_ARG_INT) ? args[0]->arg.value : 0;
+}
+
+void perf_fn_dht_get(sh_eval_ctx_t* ctx, sh_bc_arg_t* ret_arg, const arg_count_t arg_count, sh_bc_arg_type_t* arg_type, sh_bc_arg_t** args)
+{
+	ret_arg->arg.value = 0;
+}
+
+const char* perf_eval_stmt[] = {
+	"# var1 := 10; func1( var1 )",
+	"## var1 := 5; func2( var1 )",
+"## last_dt; ## last_ev; # sdt := sysdate();"
+"(last_ev <= 0) ?? { gpio_set(4, 1); last_ev := 1; last_dt := sdt; print(last_ev, last_dt) };"
+"# temp = 0; # hmd = 0; # res := dht_get(1, temp, hmd);"
+"(res & (hmd >= 5000) & (last_dt + 30 < sdt)) ?? { gpio_set(4, 1); last_ev := 2; last_dt := sdt; print(last_ev, last_dt) };"
+"(res & (hmd < 4000) & (last_dt + 30 < sdt)) ?? { gpio_set(4, 0); last_ev := 3; last_dt := sdt; print(last_ev, last_dt) };"
+"((last_ev <= 2) & (last_dt + 600 < sdt)) ?? { gpio_set(4, 0); last_ev := 4; last_dt := sdt };",
+};
+
+/* Baseline for executor changes: stmt_eval of already parsed bytecode */
+TEST_F(LshPerfClass, EvalThroughput)
+{
+	sh_func_entry_t fn_entry[] = {
+		{ LSH_SERVICE_ID, 0, 0, 0, "func1", { perf_fn_stub } },
+		{ LSH_SERVICE_ID, 0, 0, 0, "func2", { perf_fn_stub } },
+		{ LSH_SERVICE_ID, 0, 0, 0, "gpio_set", { perf_fn_stub } },
+		{ LSH_SERVICE_ID, 0, 0, 0, "dht_get", { perf_fn_dht_get } },
+	};
+	uint32 i;
+	for (i = 0; i < sizeof(fn_entry) / sizeof(fn_entry[0]); i++) {
+		sh_errcode_t res = sh_func_register(&fn_entry[i]);
+		ASSERT_TRUE((res == SH_ERR_SUCCESS) || (res == SH_FUNC_EXISTS));
+	}
+
+	for (i = 0; i < sizeof(perf_eval_stmt) / sizeof(perf_eval_stmt[0]); i++) {
+		ASSERT_EQ(stmt_parse(perf_eval_stmt[i], "", &hstmt), SH_ERR_SUCCESS);
+
+		sh_eval_ctx_t ctx;
+		uint32 success = 0;
+		uint32 j;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (j = 0; j < PERF_EVAL_ROUNDS; j++) {
+			os_memset(&ctx, 0, sizeof(ctx));
+			if (stmt_eval(hstmt, &ctx) == SH_ERR_SUCCESS)
+				success++;
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		sh_stmt_info_t info;
+		ASSERT_EQ(stmt_info(hstmt, &info), SH_ERR_SUCCESS);
+		stmt_free(hstmt);
+		ASSERT_EQ(success, PERF_EVAL_ROUNDS);
+
+		printf("lsh eval stmt: %u, bytecode: %u bytes, rounds: %u, rate: %.0f eval/s, %.1f ns/eval\n",
+			i, info.length, PERF_EVAL_ROUNDS, PERF_EVAL_ROUNDS / elapsed, elapsed * 1e9 / PERF_EVAL_ROUNDS);
+	}
+}
+#endif